@@ -22,6 +22,9 @@
 
 #include <boost/program_options.hpp>
 #include <boost/format.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include "elf_parser.hpp"
 
 using namespace elf_parser;
@@ -36,14 +39,120 @@ void* Elf_Mmap::get_mmap() {
 }
 
 
+size_t Elf_Mmap::get_size() {
+    return mmap_size;
+}
+
+
 void Parser::setup(std::string prog_path) {
+    p_file_path = prog_path;
+    p_invalid_reason = "not validated";
     p_prog_mmap = make_unique<Elf_Mmap>(prog_path);
     p_prog_mmap->set_elf_header(p_prog_mmap->get_mmap());
-    p_prog_mmap->set_section_headers(p_prog_mmap->get_mmap());
+    if ( p_prog_mmap->get_size() >= sizeof(Elf64_Ehdr) ) {
+        p_prog_mmap->set_section_headers(p_prog_mmap->get_mmap());
+    }
     return;
 }
 
 
+// True if [offset, offset + len) lies inside a mapping of `size` bytes, without overflowing
+static bool in_bounds(uint64_t offset, uint64_t len, uint64_t size) {
+    return offset <= size && len <= size - offset;
+}
+
+
+// Check every table and string table referenced by the accessors against the mapping, in a
+// single pass over the section headers. Files that pass can be read without further checks
+bool Parser::validate() {
+    Elf64_Ehdr* p_elf_header = p_prog_mmap->get_elf_header();
+    size_t size = p_prog_mmap->get_size();
+
+    if ( p_prog_mmap->get_mmap() == nullptr ) {
+        p_invalid_reason = "file is empty or could not be mapped";
+        return false;
+    }
+    if ( size < sizeof(Elf64_Ehdr) ) {
+        p_invalid_reason = "file is too small to contain an ELF header";
+        return false;
+    }
+    if ( !check_ELF64_magic(p_elf_header->e_ident, PARSER_NONVERBOSE) ) {
+        p_invalid_reason = "ELF magic is malformed";
+        return false;
+    }
+    if ( get_ei_class() != ELFCLASS64 ) {
+        p_invalid_reason = "not a 64 bit ELF";
+        return false;
+    }
+    if ( p_elf_header->e_phnum > 0 &&
+         !in_bounds(p_elf_header->e_phoff, (uint64_t) p_elf_header->e_phnum * p_elf_header->e_phentsize, size) ) {
+        p_invalid_reason = "program header table extends past end of file";
+        return false;
+    }
+
+    // Extended numbering keeps the real counts in section 0, which get_e_shstrndx() reads
+    bool extended = p_elf_header->e_shstrndx == SHN_XINDEX || (p_elf_header->e_shnum == 0 && p_elf_header->e_shoff != 0);
+    if ( extended && (p_elf_header->e_shentsize != sizeof(Elf64_Shdr) ||
+                      !in_bounds(p_elf_header->e_shoff, sizeof(Elf64_Shdr), size)) ) {
+        p_invalid_reason = "section header 0 extends past end of file";
+        return false;
+    }
+
+    // With no section headers nothing may refer to a section name string table
+    if ( p_elf_header->e_shnum == 0 ) {
+        if ( p_elf_header->e_shstrndx != SHN_UNDEF && p_elf_header->e_shstrndx != SHN_XINDEX ) {
+            p_invalid_reason = "section name string table index is out of range";
+            return false;
+        }
+        p_invalid_reason = nullptr;
+        return true;
+    }
+
+    if ( p_elf_header->e_shentsize != sizeof(Elf64_Shdr) ) {
+        p_invalid_reason = "unexpected section header entry size";
+        return false;
+    }
+    if ( !in_bounds(p_elf_header->e_shoff, (uint64_t) p_elf_header->e_shnum * sizeof(Elf64_Shdr), size) ) {
+        p_invalid_reason = "section header table extends past end of file";
+        return false;
+    }
+    if ( p_elf_header->e_shstrndx == SHN_UNDEF || p_elf_header->e_shstrndx >= p_elf_header->e_shnum ) {
+        p_invalid_reason = "section name string table index is out of range";
+        return false;
+    }
+
+    Elf64_Shdr* p_section_headers = p_prog_mmap->get_section_headers();
+    Elf64_Shdr* strtab = &p_section_headers[p_elf_header->e_shstrndx];
+
+    if ( strtab->sh_type == SHT_NOBITS || strtab->sh_size == 0 || !in_bounds(strtab->sh_offset, strtab->sh_size, size) ||
+         ((char*) p_prog_mmap->get_mmap())[strtab->sh_offset + strtab->sh_size - 1] != '\0' ) {
+        p_invalid_reason = "section name string table is malformed";
+        return false;
+    }
+
+    for ( int i = 0; i < p_elf_header->e_shnum; i++ ) {
+        Elf64_Shdr* section = &p_section_headers[i];
+
+        if ( section->sh_name >= strtab->sh_size ) {
+            p_invalid_reason = "section name offset is outside the string table";
+            return false;
+        }
+        if ( section->sh_type != SHT_NOBITS && !in_bounds(section->sh_offset, section->sh_size, size) ) {
+            p_invalid_reason = "section contents extend past end of file";
+            return false;
+        }
+    }
+
+    p_invalid_reason = nullptr;
+    return true;
+}
+
+
+const char* Parser::get_invalid_reason() {
+    return p_invalid_reason;
+}
+
+
 Elf64_Shdr* Elf_Mmap::get_section_headers(void) {
     Elf64_Shdr* sectheader = (Elf64_Shdr*) ((char*) prog_mmap + p_elf_header->e_shoff);
     return sectheader;
@@ -126,6 +235,801 @@ bool Parser::print_section_headers() {
 }
 
 
+int Parser::find_section(std::string sh_name) {
+    Elf64_Ehdr* p_elf_header = p_prog_mmap->get_elf_header();
+    Elf64_Shdr* p_section_headers = p_prog_mmap->get_section_headers();
+    if ( p_elf_header->e_shnum == 0 ) {
+        return -1;
+    }
+    const char* strtab = (char*) p_prog_mmap->get_mmap() + p_section_headers[p_elf_header->e_shstrndx].sh_offset;
+
+    for ( int i = 0; i < p_elf_header->e_shnum; i++ ) {
+        if ( sh_name.compare(strtab + p_section_headers[i].sh_name) == 0 ) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+
+// Copy a section's bytes to out_path entirely in-kernel. copy_file_range is tried first and
+// sendfile is used where it is unavailable (older kernels, cross-filesystem copies)
+bool Parser::extract_section(std::string sh_name, std::string out_path) {
+    int sh_idx = find_section(sh_name);
+    if ( sh_idx < 0 ) {
+        cout << "ERROR: No section named " << sh_name << endl;
+        return false;
+    }
+
+    Elf64_Shdr* p_section_headers = p_prog_mmap->get_section_headers();
+    Elf64_Shdr* section = &p_section_headers[sh_idx];
+
+    if ( section->sh_type == SHT_NOBITS ) {
+        cout << "ERROR: Section " << sh_name << " has no contents in file" << endl;
+        return false;
+    }
+
+    int in_fd, out_fd;
+    if ( (in_fd = open(p_file_path.c_str(), O_RDONLY)) < 0 ) {
+        cout << "ERROR: Could not open file " << p_file_path << endl;
+        return false;
+    }
+    if ( (out_fd = open(out_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0 ) {
+        cout << "ERROR: Could not open output file " << out_path << endl;
+        close(in_fd);
+        return false;
+    }
+
+    struct stat out_st;
+    bool out_is_file = fstat(out_fd, &out_st) == 0 && S_ISREG(out_st.st_mode);
+
+    loff_t in_off = section->sh_offset;
+    size_t remaining = section->sh_size;
+    bool use_sendfile = false;
+
+    while ( remaining > 0 ) {
+        ssize_t copied;
+        if ( !use_sendfile ) {
+            copied = copy_file_range(in_fd, &in_off, out_fd, nullptr, remaining, 0);
+            if ( copied < 0 && (errno == ENOSYS || errno == EXDEV || errno == EINVAL || errno == EOPNOTSUPP) ) {
+                use_sendfile = true;
+                continue;
+            }
+        } else {
+            off_t sf_off = in_off;
+            copied = sendfile(out_fd, in_fd, &sf_off, remaining);
+            in_off = sf_off;
+        }
+
+        if ( copied < 0 && errno == EINTR ) {
+            continue;
+        }
+        if ( copied <= 0 ) {
+            cout << "ERROR: Failed writing section to " << out_path << endl;
+            close(in_fd);
+            close(out_fd);
+            // Don't leave a truncated copy behind, but never unlink devices or pipes
+            if ( out_is_file ) {
+                unlink(out_path.c_str());
+            }
+            return false;
+        }
+        remaining -= copied;
+    }
+
+    close(in_fd);
+    close(out_fd);
+
+    if ( parser_verbose ) {
+        cout << format("Extracted %s (%u bytes) to %s") % sh_name % section->sh_size % out_path << endl;
+    }
+    return true;
+}
+
+
+// write(2) the whole buffer, retrying after short writes and interrupts
+static bool write_all(int fd, const char* buf, size_t len) {
+    while ( len > 0 ) {
+        ssize_t written = write(fd, buf, len);
+        if ( written < 0 ) {
+            if ( errno == EINTR ) {
+                continue;
+            }
+            return false;
+        }
+        buf += written;
+        len -= written;
+    }
+    return true;
+}
+
+
+// Hex dump in the same layout as `xxd`. Each byte is formatted through a 256 entry table of
+// precomputed hex pairs and lines are accumulated into a large buffer that is flushed with
+// write(2), so formatting is never the bottleneck on large sections
+bool Parser::hexdump_section(std::string sh_name) {
+    int sh_idx = find_section(sh_name);
+    if ( sh_idx < 0 ) {
+        cout << "ERROR: No section named " << sh_name << endl;
+        return false;
+    }
+
+    Elf64_Shdr* p_section_headers = p_prog_mmap->get_section_headers();
+    Elf64_Shdr* section = &p_section_headers[sh_idx];
+
+    if ( section->sh_type == SHT_NOBITS ) {
+        cout << "ERROR: Section " << sh_name << " has no contents in file" << endl;
+        return false;
+    }
+
+    static const char digits[] = "0123456789abcdef";
+    static char hex_pairs[256][2];
+    for ( int i = 0; i < 256; i++ ) {
+        hex_pairs[i][0] = digits[i >> 4];
+        hex_pairs[i][1] = digits[i & 0xf];
+    }
+
+    const unsigned char* data = (unsigned char*) p_prog_mmap->get_mmap() + section->sh_offset;
+    const size_t line_len = 76; // up to 16 offset digits + ": " + 8 groups of "xxxx " + ' ' + 16 ascii + '\n'
+    const size_t buf_lines = 4096;
+    std::unique_ptr<char[]> buf(new char[line_len * buf_lines]);
+    char* out = buf.get();
+
+    cout.flush();
+    for ( size_t line = 0; line < section->sh_size; line += 16 ) {
+        size_t n = std::min<size_t>(16, section->sh_size - line);
+        char* p = out;
+
+        // Like xxd, offsets are at least 8 digits and widen past 4 GiB
+        int addr_digits = 8;
+        while ( addr_digits < 16 && (line >> (addr_digits * 4)) != 0 ) {
+            addr_digits++;
+        }
+        uint64_t addr = line;
+        for ( int i = addr_digits - 1; i >= 0; i-- ) {
+            p[i] = digits[addr & 0xf];
+            addr >>= 4;
+        }
+        p[addr_digits] = ':';
+        p[addr_digits + 1] = ' ';
+        p += addr_digits + 2;
+
+        memset(p, ' ', 41);
+        for ( size_t i = 0; i < n; i++ ) {
+            memcpy(p + (i * 5) / 2, hex_pairs[data[line + i]], 2);
+        }
+        p += 41;
+
+        for ( size_t i = 0; i < n; i++ ) {
+            unsigned char c = data[line + i];
+            *p++ = (c >= 0x20 && c < 0x7f) ? c : '.';
+        }
+        *p++ = '\n';
+        out = p;
+
+        if ( out + line_len > buf.get() + line_len * buf_lines ) {
+            if ( !write_all(STDOUT_FILENO, buf.get(), out - buf.get()) ) {
+                return false;
+            }
+            out = buf.get();
+        }
+    }
+
+    if ( out != buf.get() && !write_all(STDOUT_FILENO, buf.get(), out - buf.get()) ) {
+        return false;
+    }
+    return true;
+}
+
+
+// Count byte occurrences into counts. Four independent banks are used so that runs of the same
+// byte value (common in padding and zero fill) do not serialize on a single counter
+static void byte_histogram(const unsigned char* data, size_t len, uint64_t counts[256]) {
+    uint64_t banks[4][256] = {};
+    size_t i = 0;
+
+    for ( ; i + 16 <= len; i += 16 ) {
+        uint64_t lo, hi;
+        memcpy(&lo, data + i, 8);
+        memcpy(&hi, data + i + 8, 8);
+        for ( int b = 0; b < 64; b += 32 ) {
+            banks[0][(lo >> b) & 0xff]++;
+            banks[1][(lo >> (b + 8)) & 0xff]++;
+            banks[2][(lo >> (b + 16)) & 0xff]++;
+            banks[3][(lo >> (b + 24)) & 0xff]++;
+            banks[0][(hi >> b) & 0xff]++;
+            banks[1][(hi >> (b + 8)) & 0xff]++;
+            banks[2][(hi >> (b + 16)) & 0xff]++;
+            banks[3][(hi >> (b + 24)) & 0xff]++;
+        }
+    }
+    for ( ; i < len; i++ ) {
+        banks[0][data[i]]++;
+    }
+
+    for ( int v = 0; v < 256; v++ ) {
+        counts[v] += banks[0][v] + banks[1][v] + banks[2][v] + banks[3][v];
+    }
+}
+
+
+// Shannon entropy in bits per byte (0.0 - 8.0). Large inputs are split into chunks that are
+// histogrammed on separate threads and merged before the entropy sum
+double Parser::byte_entropy(const unsigned char* data, size_t len) {
+    uint64_t counts[256] = {};
+
+    if ( len == 0 ) {
+        return 0.0;
+    }
+
+    size_t n_threads = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), len / ENTROPY_THREAD_CHUNK + 1);
+
+    if ( n_threads <= 1 ) {
+        byte_histogram(data, len, counts);
+    } else {
+        std::vector<std::array<uint64_t, 256>> partial(n_threads);
+        std::vector<std::thread> workers;
+        size_t chunk = len / n_threads;
+
+        for ( size_t t = 0; t < n_threads; t++ ) {
+            size_t start = t * chunk;
+            size_t end = (t == n_threads - 1) ? len : start + chunk;
+            partial[t].fill(0);
+            workers.emplace_back(byte_histogram, data + start, end - start, partial[t].data());
+        }
+        for ( size_t t = 0; t < n_threads; t++ ) {
+            workers[t].join();
+            for ( int v = 0; v < 256; v++ ) {
+                counts[v] += partial[t][v];
+            }
+        }
+    }
+
+    double entropy = 0.0;
+    for ( int v = 0; v < 256; v++ ) {
+        if ( counts[v] ) {
+            double p = (double) counts[v] / len;
+            entropy -= p * log2(p);
+        }
+    }
+
+    return entropy;
+}
+
+
+bool Parser::print_section_entropy() {
+    Elf64_Ehdr* p_elf_header = p_prog_mmap->get_elf_header();
+    Elf64_Shdr* p_section_headers = p_prog_mmap->get_section_headers();
+    const unsigned char* base = (unsigned char*) p_prog_mmap->get_mmap();
+
+    cout << format("%-4s %-24s %12s %8s") % "Idx" % "Name" % "Size" % "Entropy" << endl;
+    for ( int i = 0; i < p_elf_header->e_shnum; i++ ) {
+        Elf64_Shdr* section = &p_section_headers[i];
+
+        if ( section->sh_type == SHT_NOBITS || section->sh_size == 0 ) {
+            continue;
+        }
+
+        double entropy = byte_entropy(base + section->sh_offset, section->sh_size);
+        cout << format("%-4d %-24s %12u %8.4f%s") % i % get_sh_name(i) % section->sh_size % entropy
+                % (entropy > ENTROPY_HIGH_THRESHOLD ? "  (high: possibly packed/encrypted)" : "") << endl;
+    }
+
+    return true;
+}
+
+
+// DWARF constants used by the .debug_line decoder (see DWARF 5 section 6.2)
+enum {
+    DW_LNS_copy = 1, DW_LNS_advance_pc, DW_LNS_advance_line, DW_LNS_set_file, DW_LNS_set_column,
+    DW_LNS_negate_stmt, DW_LNS_set_basic_block, DW_LNS_const_add_pc, DW_LNS_fixed_advance_pc,
+    DW_LNE_end_sequence = 1, DW_LNE_set_address, DW_LNE_define_file,
+    DW_LNCT_path = 1, DW_LNCT_directory_index,
+    DW_FORM_block = 0x09, DW_FORM_data1 = 0x0b, DW_FORM_data2 = 0x05, DW_FORM_data4 = 0x06,
+    DW_FORM_data8 = 0x07, DW_FORM_data16 = 0x1e, DW_FORM_string = 0x08, DW_FORM_strp = 0x0e,
+    DW_FORM_line_strp = 0x1f, DW_FORM_udata = 0x0f, DW_FORM_sdata = 0x0d
+};
+
+
+// Bounds checked reader over a DWARF unit. Reads past the end set `failed` and return 0, so
+// a malformed unit is detected once at the end of decoding instead of after every read
+struct Dwarf_Cursor {
+    const unsigned char* p;
+    const unsigned char* end;
+    bool failed;
+
+    uint64_t fixed(int n) {
+        if ( end - p < n ) {
+            failed = true;
+            p = end;
+            return 0;
+        }
+        uint64_t value = 0;
+        for ( int i = 0; i < n; i++ ) {
+            value |= (uint64_t) p[i] << (i * 8);
+        }
+        p += n;
+        return value;
+    }
+
+    uint64_t uleb() {
+        uint64_t value = 0;
+        for ( int shift = 0; p < end; shift += 7 ) {
+            unsigned char b = *p++;
+            if ( shift < 64 ) {
+                value |= (uint64_t) (b & 0x7f) << shift;
+            }
+            if ( !(b & 0x80) ) {
+                return value;
+            }
+        }
+        failed = true;
+        return 0;
+    }
+
+    int64_t sleb() {
+        int64_t value = 0;
+        int shift = 0;
+        for ( ; p < end; ) {
+            unsigned char b = *p++;
+            if ( shift < 64 ) {
+                value |= (int64_t) (b & 0x7f) << shift;
+            }
+            shift += 7;
+            if ( !(b & 0x80) ) {
+                if ( shift < 64 && (b & 0x40) ) {
+                    value |= -((int64_t) 1 << shift);
+                }
+                return value;
+            }
+        }
+        failed = true;
+        return 0;
+    }
+
+    const char* cstr() {
+        const char* s = (const char*) p;
+        const unsigned char* nul = (const unsigned char*) memchr(p, '\0', end - p);
+        if ( nul == nullptr ) {
+            failed = true;
+            p = end;
+            return "";
+        }
+        p = nul + 1;
+        return s;
+    }
+
+    void skip(uint64_t n) {
+        if ( (uint64_t) (end - p) < n ) {
+            failed = true;
+            p = end;
+        } else {
+            p += n;
+        }
+    }
+};
+
+
+static const char* string_at(const char* table, size_t table_size, uint64_t offset) {
+    if ( table == nullptr || offset >= table_size || memchr(table + offset, '\0', table_size - offset) == nullptr ) {
+        return "";
+    }
+    return table + offset;
+}
+
+
+uint32_t Line_Table::intern_file(std::string path) {
+    auto it = file_ids.find(path);
+    if ( it != file_ids.end() ) {
+        return it->second;
+    }
+
+    uint32_t id = file_names.size();
+    file_ids.emplace(path, id);
+    file_names.push_back(path);
+    return id;
+}
+
+
+// Decode one line number program unit, appending its rows. Files are resolved to full paths
+// and interned so rows only carry a 32 bit file id
+bool Line_Table::decode_unit(const unsigned char* p, const unsigned char* end, int offset_size) {
+    Dwarf_Cursor cur = { p, end, false };
+
+    uint16_t version = cur.fixed(2);
+    if ( version < 2 || version > 5 ) {
+        return false;
+    }
+    if ( version >= 5 ) {
+        cur.fixed(1); // address_size
+        cur.fixed(1); // segment_selector_size
+    }
+
+    uint64_t header_length = cur.fixed(offset_size);
+    const unsigned char* program = cur.p + header_length;
+    if ( header_length > (uint64_t) (end - cur.p) ) {
+        return false;
+    }
+
+    uint8_t min_inst_length = cur.fixed(1);
+    if ( version >= 4 ) {
+        cur.fixed(1); // maximum_operations_per_instruction, only meaningful for VLIW
+    }
+    cur.fixed(1); // default_is_stmt, not needed for address -> line lookups
+    int8_t line_base = (int8_t) cur.fixed(1);
+    uint8_t line_range = cur.fixed(1);
+    uint8_t opcode_base = cur.fixed(1);
+
+    if ( line_range == 0 || opcode_base == 0 ) {
+        return false;
+    }
+
+    const unsigned char* opcode_lengths = cur.p;
+    cur.skip(opcode_base - 1);
+
+    std::vector<std::string> dirs;
+    std::vector<uint32_t> files; // unit file index -> interned id
+
+    if ( version < 5 ) {
+        // Directory 0 is the compilation directory, which is only recorded in .debug_info
+        dirs.push_back("");
+        while ( !cur.failed ) {
+            const char* dir = cur.cstr();
+            if ( *dir == '\0' ) {
+                break;
+            }
+            dirs.push_back(dir);
+        }
+
+        // File indices start at 1, so slot 0 is a placeholder
+        files.push_back(intern_file("??"));
+        while ( !cur.failed ) {
+            const char* name = cur.cstr();
+            if ( *name == '\0' ) {
+                break;
+            }
+            uint64_t dir = cur.uleb();
+            cur.uleb(); // modification time
+            cur.uleb(); // file length
+
+            std::string path = name;
+            if ( path[0] != '/' && dir < dirs.size() && !dirs[dir].empty() ) {
+                path = dirs[dir] + "/" + path;
+            }
+            files.push_back(intern_file(path));
+        }
+    } else {
+        // Version 5 describes its directory and file tables with (content type, form) pairs
+        for ( int table = 0; table < 2 && !cur.failed; table++ ) {
+            std::vector<std::pair<uint64_t, uint64_t>> format;
+            uint8_t format_count = cur.fixed(1);
+            for ( int i = 0; i < format_count; i++ ) {
+                uint64_t type = cur.uleb();
+                uint64_t form = cur.uleb();
+                format.emplace_back(type, form);
+            }
+
+            uint64_t count = cur.uleb();
+            for ( uint64_t e = 0; e < count && !cur.failed; e++ ) {
+                const char* name = "";
+                uint64_t dir = 0;
+
+                for ( auto& field : format ) {
+                    uint64_t value = 0;
+                    const char* string = nullptr;
+
+                    switch ( field.second ) {
+                        case DW_FORM_string:    string = cur.cstr(); break;
+                        case DW_FORM_line_strp: string = string_at(line_str, line_str_size, cur.fixed(offset_size)); break;
+                        case DW_FORM_strp:      string = string_at(str, str_size, cur.fixed(offset_size)); break;
+                        case DW_FORM_udata:     value = cur.uleb(); break;
+                        case DW_FORM_sdata:     value = cur.sleb(); break;
+                        case DW_FORM_data1:     value = cur.fixed(1); break;
+                        case DW_FORM_data2:     value = cur.fixed(2); break;
+                        case DW_FORM_data4:     value = cur.fixed(4); break;
+                        case DW_FORM_data8:     value = cur.fixed(8); break;
+                        case DW_FORM_data16:    cur.skip(16); break;
+                        case DW_FORM_block:     cur.skip(cur.uleb()); break;
+                        default:                return false; // e.g. DW_FORM_strx needs .debug_str_offsets
+                    }
+
+                    if ( field.first == DW_LNCT_path && string != nullptr ) {
+                        name = string;
+                    } else if ( field.first == DW_LNCT_directory_index ) {
+                        dir = value;
+                    }
+                }
+
+                if ( table == 0 ) {
+                    dirs.push_back(name);
+                } else {
+                    std::string path = name;
+                    if ( path[0] != '/' && dir < dirs.size() && !dirs[dir].empty() ) {
+                        path = dirs[dir] + "/" + path;
+                    }
+                    files.push_back(intern_file(path));
+                }
+            }
+        }
+    }
+
+    if ( cur.failed ) {
+        return false;
+    }
+
+    // Run the line number state machine
+    cur.p = program;
+    uint64_t address = 0;
+    uint64_t file = 1;
+    int64_t line = 1;
+    size_t sequence_start = rows.size();
+
+    auto emit = [&](bool end_sequence) {
+        // Lines outside the 31 bit row field only come from malformed programs; drop the unit
+        if ( line < 0 || line >= ((int64_t) 1 << 31) ) {
+            cur.failed = true;
+            return;
+        }
+        Line_Row row;
+        row.address = address;
+        row.file = file < files.size() ? files[file] : intern_file("??");
+        row.line = line;
+        row.end_sequence = end_sequence;
+        rows.push_back(row);
+    };
+
+    while ( cur.p < cur.end && !cur.failed ) {
+        uint8_t opcode = cur.fixed(1);
+
+        if ( opcode >= opcode_base ) {
+            uint8_t adjusted = opcode - opcode_base;
+            address += (adjusted / line_range) * min_inst_length;
+            line += line_base + (adjusted % line_range);
+            emit(false);
+            continue;
+        }
+
+        switch ( opcode ) {
+            case 0: {
+                uint64_t len = cur.uleb();
+                const unsigned char* next = cur.p + len;
+                if ( len == 0 || len > (uint64_t) (cur.end - cur.p) ) {
+                    return false;
+                }
+
+                switch ( cur.fixed(1) ) {
+                    case DW_LNE_end_sequence:
+                        emit(true);
+                        // Sequences at address -1 (or 0, outside relocatable objects where every
+                        // section starts at 0) are discarded code the linker tombstoned
+                        if ( rows[sequence_start].address == (uint64_t) -1 ||
+                             (!relocatable && rows[sequence_start].address == 0) ) {
+                            rows.resize(sequence_start);
+                        }
+                        sequence_start = rows.size();
+                        address = 0;
+                        file = 1;
+                        line = 1;
+                        break;
+                    case DW_LNE_set_address:
+                        address = cur.fixed(len - 1 > 8 ? 8 : len - 1);
+                        break;
+                    case DW_LNE_define_file: {
+                        const char* name = cur.cstr();
+                        uint64_t dir = cur.uleb();
+                        std::string path = name;
+                        if ( path[0] != '/' && dir < dirs.size() && !dirs[dir].empty() ) {
+                            path = dirs[dir] + "/" + path;
+                        }
+                        files.push_back(intern_file(path));
+                        break;
+                    }
+                    default:
+                        break;
+                }
+                cur.p = next;
+                break;
+            }
+            case DW_LNS_copy:           emit(false); break;
+            case DW_LNS_advance_pc:     address += cur.uleb() * min_inst_length; break;
+            case DW_LNS_advance_line:   line += cur.sleb(); break;
+            case DW_LNS_set_file:       file = cur.uleb(); break;
+            case DW_LNS_const_add_pc:   address += ((255 - opcode_base) / line_range) * min_inst_length; break;
+            case DW_LNS_fixed_advance_pc: address += cur.fixed(2); break;
+            default:
+                // Skip the operands of opcodes that don't affect address or line
+                for ( int i = 0; i < opcode_lengths[opcode - 1]; i++ ) {
+                    cur.uleb();
+                }
+                break;
+        }
+    }
+
+    // Drop a trailing sequence that was never terminated
+    rows.resize(sequence_start);
+
+    return !cur.failed;
+}
+
+
+bool Line_Table::build(const unsigned char* debug_line, size_t debug_line_size,
+                       const char* p_line_str, size_t p_line_str_size,
+                       const char* p_str, size_t p_str_size, bool p_relocatable) {
+    bool ok = true;
+    relocatable = p_relocatable;
+    line_str = p_line_str;
+    line_str_size = p_line_str_size;
+    str = p_str;
+    str_size = p_str_size;
+
+    Dwarf_Cursor cur = { debug_line, debug_line + debug_line_size, false };
+    while ( cur.p < cur.end ) {
+        // A length of 0xffffffff introduces the 64 bit DWARF format with 8 byte offsets
+        int offset_size = 4;
+        uint64_t unit_length = cur.fixed(4);
+        if ( unit_length == 0xffffffff ) {
+            offset_size = 8;
+            unit_length = cur.fixed(8);
+        }
+        // A truncated unit header or overlong unit ends decoding, keeping earlier units' rows
+        if ( cur.failed || unit_length > (uint64_t) (cur.end - cur.p) ) {
+            ok = false;
+            break;
+        }
+
+        // A bad unit loses its own rows but doesn't prevent decoding the rest
+        size_t n_rows = rows.size();
+        if ( !decode_unit(cur.p, cur.p + unit_length, offset_size) ) {
+            rows.resize(n_rows);
+        }
+        cur.p += unit_length;
+    }
+
+    // End of sequence rows sort first at equal addresses so an adjacent sequence starting
+    // at the same address takes precedence in lookup()
+    std::stable_sort(rows.begin(), rows.end(), [](const Line_Row& a, const Line_Row& b) {
+        if ( a.address != b.address ) {
+            return a.address < b.address;
+        }
+        return a.end_sequence > b.end_sequence;
+    });
+    rows.shrink_to_fit();
+
+    return ok;
+}
+
+
+// Return the row covering address, or nullptr if it falls outside every sequence
+const Line_Row* Line_Table::lookup(uint64_t address) {
+    auto it = std::upper_bound(rows.begin(), rows.end(), address, [](uint64_t addr, const Line_Row& row) {
+        return addr < row.address;
+    });
+
+    if ( it == rows.begin() || (it - 1)->end_sequence ) {
+        return nullptr;
+    }
+    return &*(it - 1);
+}
+
+
+// Relocatable objects leave the address and string offset fields of debug sections for the
+// linker to fill in. Apply the absolute relocations targeting sh_idx to a copy of its contents
+bool Parser::relocate_section(int sh_idx, std::vector<unsigned char>& contents) {
+    Elf64_Ehdr* p_elf_header = p_prog_mmap->get_elf_header();
+    Elf64_Shdr* p_section_headers = p_prog_mmap->get_section_headers();
+    const char* base = (char*) p_prog_mmap->get_mmap();
+
+    for ( int i = 0; i < p_elf_header->e_shnum; i++ ) {
+        Elf64_Shdr* rela = &p_section_headers[i];
+        if ( rela->sh_type != SHT_RELA || rela->sh_info != (uint32_t) sh_idx ) {
+            continue;
+        }
+        if ( rela->sh_link >= p_elf_header->e_shnum || p_section_headers[rela->sh_link].sh_type != SHT_SYMTAB ) {
+            return false;
+        }
+
+        Elf64_Shdr* symtab = &p_section_headers[rela->sh_link];
+        const Elf64_Sym* syms = (const Elf64_Sym*) (base + symtab->sh_offset);
+        size_t n_syms = symtab->sh_size / sizeof(Elf64_Sym);
+        const Elf64_Rela* relas = (const Elf64_Rela*) (base + rela->sh_offset);
+        size_t n_relas = rela->sh_size / sizeof(Elf64_Rela);
+
+        for ( size_t r = 0; r < n_relas; r++ ) {
+            size_t width = 0;
+            uint32_t type = ELF64_R_TYPE(relas[r].r_info);
+
+            if ( p_elf_header->e_machine == EM_X86_64 ) {
+                width = type == R_X86_64_64 ? 8 : (type == R_X86_64_32 || type == R_X86_64_32S) ? 4 : 0;
+            } else if ( p_elf_header->e_machine == EM_AARCH64 ) {
+                width = type == R_AARCH64_ABS64 ? 8 : type == R_AARCH64_ABS32 ? 4 : 0;
+            }
+
+            uint64_t sym = ELF64_R_SYM(relas[r].r_info);
+            if ( width == 0 || sym >= n_syms || relas[r].r_offset > contents.size() ||
+                 width > contents.size() - relas[r].r_offset ) {
+                continue;
+            }
+
+            uint64_t value = syms[sym].st_value + relas[r].r_addend;
+            memcpy(&contents[relas[r].r_offset], &value, width);
+        }
+    }
+
+    return true;
+}
+
+
+const Line_Row* Parser::lookup_line(uint64_t address) {
+    if ( p_line_table == nullptr ) {
+        p_line_table = make_unique<Line_Table>();
+
+        Elf64_Shdr* p_section_headers = p_prog_mmap->get_section_headers();
+        const char* base = (char*) p_prog_mmap->get_mmap();
+        int debug_line = find_section(".debug_line");
+        int line_str = find_section(".debug_line_str");
+        int str = find_section(".debug_str");
+
+        if ( debug_line < 0 || p_section_headers[debug_line].sh_type == SHT_NOBITS ) {
+            if ( parser_verbose ) {
+                cout << "WARN: No .debug_line section, line information is unavailable" << endl;
+            }
+            return nullptr;
+        }
+        if ( p_section_headers[debug_line].sh_flags & SHF_COMPRESSED ) {
+            if ( parser_verbose ) {
+                cout << "WARN: Compressed debug sections are not supported" << endl;
+            }
+            return nullptr;
+        }
+
+        // String sections without usable contents are treated as absent
+        for ( int* idx : { &line_str, &str } ) {
+            if ( *idx >= 0 && (p_section_headers[*idx].sh_type == SHT_NOBITS ||
+                               (p_section_headers[*idx].sh_flags & SHF_COMPRESSED)) ) {
+                *idx = -1;
+            }
+        }
+
+        const unsigned char* line_data = (unsigned char*) base + p_section_headers[debug_line].sh_offset;
+        std::vector<unsigned char> relocated;
+        bool relocatable = p_prog_mmap->get_elf_header()->e_type == ET_REL;
+        if ( relocatable ) {
+            relocated.assign(line_data, line_data + p_section_headers[debug_line].sh_size);
+            relocate_section(debug_line, relocated);
+            line_data = relocated.data();
+        }
+
+        bool ok = p_line_table->build(line_data,
+                                      p_section_headers[debug_line].sh_size,
+                                      line_str < 0 ? nullptr : base + p_section_headers[line_str].sh_offset,
+                                      line_str < 0 ? 0 : p_section_headers[line_str].sh_size,
+                                      str < 0 ? nullptr : base + p_section_headers[str].sh_offset,
+                                      str < 0 ? 0 : p_section_headers[str].sh_size,
+                                      relocatable);
+        if ( !ok && parser_verbose ) {
+            cout << "WARN: .debug_line is malformed, some line information may be missing" << endl;
+        }
+    }
+
+    return p_line_table->lookup(address);
+}
+
+
+// Print file:line for each address in the same form as addr2line, "??:0" when unknown
+bool Parser::print_line_info(std::vector<uint64_t> addresses) {
+    for ( uint64_t address : addresses ) {
+        const Line_Row* row = lookup_line(address);
+        if ( row == nullptr ) {
+            cout << format("0x%lx: ??:0") % address << endl;
+        } else {
+            cout << format("0x%lx: %s:%u") % address % p_line_table->file_names[row->file] % row->line << endl;
+        }
+    }
+    return true;
+}
+
+
 const char* Parser::get_sh_size(int sh_idx) {
     Elf64_Shdr* p_section_headers = p_prog_mmap->get_section_headers();
     static char ret_string[32];
@@ -154,8 +1058,8 @@ const char* Parser::get_sh_addr(int sh_idx) {
 
 const char* Parser::get_sh_type(int sh_idx) {
     Elf64_Shdr* p_section_headers = p_prog_mmap->get_section_headers();
-    static char ret_string[32];
-    snprintf(ret_string, 32, "%d", p_section_headers[sh_idx].sh_type);
+    static char ret_string[64];
+    snprintf(ret_string, 64, "%d", p_section_headers[sh_idx].sh_type);
 
     switch (p_section_headers[sh_idx].sh_type) {
         case SHT_NULL:           return "Null Section";
@@ -565,6 +1469,402 @@ const uint8_t Parser::get_ei_class() {
 }
 
 
+Elf_Watcher::Elf_Watcher(int debounce) {
+    debounce_ms = debounce;
+    overflowed = false;
+    if ( (inotify_fd = inotify_init1(IN_CLOEXEC)) < 0 ) {
+        cout << "ERROR: Could not initialize inotify" << endl;
+        exit(1);
+    }
+}
+
+
+Elf_Watcher::~Elf_Watcher(void) {
+    if ( inotify_fd >= 0 ) {
+        close(inotify_fd);
+    }
+}
+
+
+// Parse the header of a single file into the index. `changed` is set when an inotify event has
+// already shown the file was created or written; otherwise (tree walks, rescans) files whose
+// inode, size and nanosecond mtime match the index are skipped
+bool Elf_Watcher::index_file(std::string file_path, bool changed) {
+    struct stat st;
+
+    if ( stat(file_path.c_str(), &st) < 0 || !S_ISREG(st.st_mode) ) {
+        remove_file(file_path);
+        return false;
+    }
+
+    auto it = index.find(file_path);
+    if ( !changed && it != index.end() && it->second.ino == st.st_ino && it->second.size == st.st_size &&
+         it->second.mtime.tv_sec == st.st_mtim.tv_sec && it->second.mtime.tv_nsec == st.st_mtim.tv_nsec ) {
+        return true;
+    }
+
+    Parser parser = Parser(file_path);
+    if ( !parser.validate() ) {
+        remove_file(file_path);
+        return false;
+    }
+    Elf64_Ehdr* p_elf_header = parser.p_prog_mmap->get_elf_header();
+
+    Elf_Index_Entry entry;
+    entry.mtime = st.st_mtim;
+    entry.ino = st.st_ino;
+    entry.size = st.st_size;
+    entry.e_type = p_elf_header->e_type;
+    entry.e_machine = p_elf_header->e_machine;
+    entry.e_shnum = p_elf_header->e_shnum;
+    index[file_path] = entry;
+
+    cout << format("[indexed] %s: %s, %s, %u sections") % file_path % parser.get_e_type()
+            % parser.get_e_machine() % entry.e_shnum << endl;
+
+    return true;
+}
+
+
+void Elf_Watcher::remove_file(std::string file_path) {
+    if ( index.erase(file_path) ) {
+        cout << format("[removed] %s") % file_path << endl;
+    }
+}
+
+
+// inotify watches are not recursive, so each subdirectory gets its own watch descriptor.
+// Files already present are indexed as the tree is walked
+bool Elf_Watcher::add_watch_tree(std::string dir_path) {
+    uint32_t mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE | IN_DELETE_SELF;
+    int wd = inotify_add_watch(inotify_fd, dir_path.c_str(), mask);
+
+    if ( wd < 0 ) {
+        cout << "ERROR: Could not watch directory " << dir_path << endl;
+        return false;
+    }
+    watch_dirs[wd] = dir_path;
+
+    DIR* dir = opendir(dir_path.c_str());
+    if ( dir == nullptr ) {
+        return false;
+    }
+
+    struct dirent* ent;
+    while ( (ent = readdir(dir)) != nullptr ) {
+        std::string name = ent->d_name;
+        if ( name == "." || name == ".." ) {
+            continue;
+        }
+
+        std::string path = dir_path + "/" + name;
+        struct stat st;
+        if ( lstat(path.c_str(), &st) < 0 ) {
+            continue;
+        }
+
+        if ( S_ISDIR(st.st_mode) ) {
+            add_watch_tree(path);
+        } else if ( S_ISREG(st.st_mode) ) {
+            index_file(path, false);
+        }
+    }
+    closedir(dir);
+
+    return true;
+}
+
+
+// Forget a directory that was deleted or moved out of the tree: drop the index entries and
+// watches for everything beneath it
+void Elf_Watcher::remove_watch_tree(std::string dir_path) {
+    std::string prefix = dir_path + "/";
+
+    for ( auto it = watch_dirs.begin(); it != watch_dirs.end(); ) {
+        if ( it->second == dir_path || it->second.compare(0, prefix.size(), prefix) == 0 ) {
+            inotify_rm_watch(inotify_fd, it->first);
+            it = watch_dirs.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    std::vector<std::string> removed;
+    for ( auto& entry : index ) {
+        if ( entry.first.compare(0, prefix.size(), prefix) == 0 ) {
+            removed.push_back(entry.first);
+        }
+    }
+    for ( auto& path : removed ) {
+        remove_file(path);
+    }
+}
+
+
+// Resynchronise with the disk after the event queue overflowed and events were lost
+void Elf_Watcher::rescan() {
+    cout << format("WARN: inotify queue overflowed, rescanning %s") % root_path << endl;
+
+    std::vector<std::string> stale;
+    for ( auto& entry : index ) {
+        struct stat st;
+        if ( stat(entry.first.c_str(), &st) < 0 || !S_ISREG(st.st_mode) ) {
+            stale.push_back(entry.first);
+        }
+    }
+    for ( auto& path : stale ) {
+        remove_file(path);
+    }
+
+    for ( auto it = watch_dirs.begin(); it != watch_dirs.end(); ) {
+        struct stat st;
+        if ( stat(it->second.c_str(), &st) < 0 || !S_ISDIR(st.st_mode) ) {
+            inotify_rm_watch(inotify_fd, it->first);
+            it = watch_dirs.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    add_watch_tree(root_path);
+}
+
+
+// Drain all queued inotify events into pending (path -> removed). Later events for the same
+// path overwrite earlier ones, which coalesces e.g. a create/write/rename sequence into one entry
+void Elf_Watcher::read_events(std::map<std::string, bool>& pending) {
+    alignas(struct inotify_event) char buf[4096];
+    ssize_t len;
+
+    while ( (len = read(inotify_fd, buf, sizeof(buf))) > 0 ) {
+        for ( char* p = buf; p < buf + len; p += sizeof(struct inotify_event) + ((struct inotify_event*) p)->len ) {
+            struct inotify_event* event = (struct inotify_event*) p;
+
+            if ( event->mask & IN_Q_OVERFLOW ) {
+                overflowed = true;
+                continue;
+            }
+
+            if ( event->mask & IN_IGNORED ) {
+                watch_dirs.erase(event->wd);
+                continue;
+            }
+
+            auto dir = watch_dirs.find(event->wd);
+            if ( dir == watch_dirs.end() || event->len == 0 ) {
+                continue;
+            }
+
+            std::string path = dir->second + "/" + event->name;
+
+            if ( event->mask & IN_ISDIR ) {
+                if ( event->mask & (IN_CREATE | IN_MOVED_TO) ) {
+                    add_watch_tree(path);
+                } else if ( event->mask & (IN_DELETE | IN_MOVED_FROM) ) {
+                    remove_watch_tree(path);
+                }
+            } else if ( event->mask & (IN_DELETE | IN_MOVED_FROM) ) {
+                pending[path] = true;
+            } else if ( event->mask & (IN_CREATE | IN_CLOSE_WRITE | IN_MOVED_TO) ) {
+                // IN_CREATE covers hard links and other files that appear without being
+                // written. A file still being written fails validation and is picked up
+                // again by its IN_CLOSE_WRITE
+                pending[path] = false;
+            }
+        }
+    }
+}
+
+
+bool Elf_Watcher::watch(std::string dir_path) {
+    int flags = fcntl(inotify_fd, F_GETFL);
+    fcntl(inotify_fd, F_SETFL, flags | O_NONBLOCK);
+
+    root_path = dir_path;
+    if ( !add_watch_tree(dir_path) ) {
+        return false;
+    }
+    cout << format("Watching %s (%u files indexed)") % dir_path % index.size() << endl;
+
+    struct pollfd pfd = { inotify_fd, POLLIN, 0 };
+    std::map<std::string, bool> pending;
+
+    while ( !watch_dirs.empty() ) {
+        // Block until something happens, then keep collecting until the tree has been
+        // quiet for debounce_ms so that closely spaced events are handled as one batch.
+        // Continuous churn is cut off after WATCH_MAX_BATCH_DELAY_MS so batches still run
+        if ( poll(&pfd, 1, -1) < 0 ) {
+            if ( errno == EINTR ) {
+                continue;
+            }
+            return false;
+        }
+
+        auto deadline = std::chrono::steady_clock::now() +
+                        std::chrono::milliseconds(std::max(debounce_ms, WATCH_MAX_BATCH_DELAY_MS));
+        int timeout;
+        do {
+            read_events(pending);
+            auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+            timeout = std::min<int>(debounce_ms, std::max<int>(0, remaining.count()));
+        } while ( timeout > 0 && poll(&pfd, 1, timeout) > 0 );
+
+        if ( overflowed ) {
+            overflowed = false;
+            pending.clear();
+            rescan();
+            continue;
+        }
+
+        for ( auto& change : pending ) {
+            if ( change.second ) {
+                remove_file(change.first);
+            } else {
+                index_file(change.first, true);
+            }
+        }
+        pending.clear();
+    }
+
+    return true;
+}
+
+
+Inventory_Writer::Inventory_Writer(std::string out_path) {
+    n_files = 0;
+    n_sections = 0;
+    prev_addr = 0;
+    prev_offset = 0;
+
+    out.open(out_path, std::ios::binary | std::ios::trunc);
+    if ( !out ) {
+        cout << "ERROR: Could not open output file " << out_path << endl;
+        exit(1);
+    }
+    out.write("ELFINV1", 8);
+}
+
+
+Inventory_Writer::~Inventory_Writer(void) {
+    if ( out.is_open() ) {
+        close();
+    }
+}
+
+
+void Inventory_Writer::put_varint(std::string& buf, uint64_t value) {
+    while ( value >= 0x80 ) {
+        buf.push_back((char) (value | 0x80));
+        value >>= 7;
+    }
+    buf.push_back((char) value);
+}
+
+
+void Inventory_Writer::put_zigzag(std::string& buf, int64_t value) {
+    put_varint(buf, ((uint64_t) value << 1) ^ (uint64_t) (value >> 63));
+}
+
+
+// Map a string to its dictionary id, queueing unseen strings for the next row group header
+uint64_t Inventory_Writer::intern(const char* str) {
+    auto it = dictionary.find(str);
+    if ( it != dictionary.end() ) {
+        return it->second;
+    }
+
+    uint64_t id = dictionary.size();
+    dictionary.emplace(str, id);
+    new_strings.emplace_back(str);
+    return id;
+}
+
+
+bool Inventory_Writer::add_file(Parser& parser, std::string file_path) {
+    Elf64_Ehdr* p_elf_header = parser.p_prog_mmap->get_elf_header();
+    Elf64_Shdr* p_section_headers = parser.p_prog_mmap->get_section_headers();
+    const char* strtab = nullptr;
+    if ( p_elf_header->e_shnum > 0 ) {
+        strtab = (char*) parser.p_prog_mmap->get_mmap() + p_section_headers[p_elf_header->e_shstrndx].sh_offset;
+    }
+
+    put_varint(columns[COL_FILE_PATH], file_path.size());
+    columns[COL_FILE_PATH].append(file_path);
+    put_varint(columns[COL_FILE_SIZE], parser.p_prog_mmap->get_size());
+    put_varint(columns[COL_FILE_TYPE], intern(parser.get_e_type()));
+    put_varint(columns[COL_FILE_MACHINE], intern(parser.get_e_machine()));
+    put_varint(columns[COL_FILE_NSECT], p_elf_header->e_shnum);
+
+    for ( int i = 0; i < p_elf_header->e_shnum; i++ ) {
+        Elf64_Shdr* section = &p_section_headers[i];
+
+        put_varint(columns[COL_SECT_NAME], intern(strtab + section->sh_name));
+        put_varint(columns[COL_SECT_TYPE], intern(parser.get_sh_type(i)));
+        put_zigzag(columns[COL_SECT_ADDR], (int64_t) (section->sh_addr - prev_addr));
+        put_zigzag(columns[COL_SECT_OFFSET], (int64_t) (section->sh_offset - prev_offset));
+        put_varint(columns[COL_SECT_SIZE], section->sh_size);
+        put_varint(columns[COL_SECT_ENTSIZE], section->sh_entsize);
+
+        prev_addr = section->sh_addr;
+        prev_offset = section->sh_offset;
+    }
+
+    n_files++;
+    n_sections += p_elf_header->e_shnum;
+
+    if ( n_sections >= INVENTORY_ROW_GROUP_SECTIONS ) {
+        return flush_row_group();
+    }
+    return true;
+}
+
+
+bool Inventory_Writer::flush_row_group() {
+    if ( n_files == 0 ) {
+        return true;
+    }
+
+    std::string header;
+    put_varint(header, n_files);
+    put_varint(header, n_sections);
+    put_varint(header, new_strings.size());
+    for ( auto& str : new_strings ) {
+        put_varint(header, str.size());
+        header.append(str);
+    }
+    out.write(header.data(), header.size());
+
+    for ( int c = 0; c < COL_COUNT; c++ ) {
+        std::string len;
+        put_varint(len, columns[c].size());
+        out.write(len.data(), len.size());
+        out.write(columns[c].data(), columns[c].size());
+        columns[c].clear();
+    }
+
+    // Address and offset deltas restart with each row group. The dictionary carries over, so
+    // only strings first seen in the next group will be written with it
+    new_strings.clear();
+    n_files = 0;
+    n_sections = 0;
+    prev_addr = 0;
+    prev_offset = 0;
+
+    if ( !out ) {
+        cout << "ERROR: Failed writing inventory row group" << endl;
+        return false;
+    }
+    return true;
+}
+
+
+bool Inventory_Writer::close() {
+    bool ok = flush_row_group();
+    out.close();
+    return ok && !out.fail();
+}
+
+
 int main(int argc, char* argv[]) {
     po::options_description desc(
     "ELF Parser 1.0.0\n"
@@ -575,26 +1875,67 @@ int main(int argc, char* argv[]) {
     desc.add_options()
         ("help", "produce help message")
         ("headers", "print program headers")
-        ("sections", "prints section headers");
+        ("sections", "prints section headers")
+        ("extract", po::value<std::string>(), "extract the raw contents of a section (requires -o)")
+        ("output,o", po::value<std::string>(), "output file for --extract")
+        ("hexdump", po::value<std::string>(), "hex dump the contents of a section")
+        ("entropy", "print byte entropy of each section")
+        ("export", po::value<std::string>(), "write a columnar section inventory of the input files")
+        ("addr2line", po::value<std::vector<std::string>>(), "resolve an address (hex) to file:line using .debug_line, may be repeated")
+        ("input", po::value<std::vector<std::string>>(), "input ELF files (default: test)")
+        ("watch", po::value<std::string>(), "watch a directory and re-index binaries as they change")
+        ("debounce", po::value<int>()->default_value(200), "milliseconds of quiet before a watch batch is re-indexed");
+
 
+    po::positional_options_description pos;
+    pos.add("input", -1);
 
     po::variables_map vm;
-    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::store(po::command_line_parser(argc, argv).options(desc).positional(pos).run(), vm);
     po::notify(vm);    
 
-    std::string prog_path = "test";
-    Parser parser = Parser(prog_path, 1);
-
-    if ( parser.get_ei_class() != ELFCLASS64 ) {
-        cout << "ERROR: Only 64 bit ELF executables are supported, exiting" << endl;
-        return 1;
-    }
-
     if ( vm.count("help") ) {
         cout << desc << "\n";
         return 0;
     }
 
+    if ( vm.count("watch") ) {
+        if ( vm["debounce"].as<int>() < 0 ) {
+            cout << "ERROR: --debounce must not be negative" << endl;
+            return 1;
+        }
+        Elf_Watcher watcher(vm["debounce"].as<int>());
+        return watcher.watch(vm["watch"].as<std::string>()) ? 0 : 1;
+    }
+
+    std::vector<std::string> inputs = { "test" };
+    if ( vm.count("input") ) {
+        inputs = vm["input"].as<std::vector<std::string>>();
+    }
+
+    if ( vm.count("export") ) {
+        Inventory_Writer writer(vm["export"].as<std::string>());
+        for ( auto& path : inputs ) {
+            Parser file_parser = Parser(path);
+            if ( !file_parser.validate() ) {
+                cout << format("WARN: Skipping %s: %s") % path % file_parser.get_invalid_reason() << endl;
+                continue;
+            }
+            if ( !writer.add_file(file_parser, path) ) {
+                return 1;
+            }
+        }
+        return writer.close() ? 0 : 1;
+    }
+
+    std::string prog_path = inputs[0];
+    Parser parser = Parser(prog_path, 1);
+
+    if ( !parser.validate() ) {
+        cout << format("ERROR: %s: %s, exiting") % prog_path % parser.get_invalid_reason() << endl;
+        return 1;
+    }
+
     if ( vm.count("headers") ) {
         parser.print_elf_header();
     }
@@ -603,5 +1944,40 @@ int main(int argc, char* argv[]) {
         parser.print_section_headers();
     }
 
+    if ( vm.count("entropy") ) {
+        parser.print_section_entropy();
+    }
+
+    if ( vm.count("addr2line") ) {
+        std::vector<uint64_t> addresses;
+        for ( auto& addr : vm["addr2line"].as<std::vector<std::string>>() ) {
+            char* end;
+            errno = 0;
+            uint64_t address = strtoull(addr.c_str(), &end, 16);
+            if ( addr.empty() || *end != '\0' || errno == ERANGE ) {
+                cout << "ERROR: Invalid address " << addr << endl;
+                return 1;
+            }
+            addresses.push_back(address);
+        }
+        parser.print_line_info(addresses);
+    }
+
+    if ( vm.count("extract") ) {
+        if ( !vm.count("output") ) {
+            cout << "ERROR: --extract requires an output file (-o)" << endl;
+            return 1;
+        }
+        if ( !parser.extract_section(vm["extract"].as<std::string>(), vm["output"].as<std::string>()) ) {
+            return 1;
+        }
+    }
+
+    if ( vm.count("hexdump") ) {
+        if ( !parser.hexdump_section(vm["hexdump"].as<std::string>()) ) {
+            return 1;
+        }
+    }
+
     return 0;
 }
\ No newline at end of file
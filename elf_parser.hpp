@@ -24,9 +24,19 @@
 #define H_ELF_PARSE_
 
 #include <iostream>
+#include <fstream>
 #include <string>
+#include <array>
+#include <map>
+#include <thread>
+#include <vector>
+#include <unordered_map>
 #include <sys/stat.h>
+#include <sys/inotify.h>
+#include <dirent.h>
+#include <poll.h>
 #include <sys/mman.h>
+#include <sys/sendfile.h>
 #include <unistd.h>
 #include <elf.h>
 #include <fcntl.h>
@@ -36,6 +46,15 @@ using namespace std;
 #define PARSER_VERBOSE 1
 #define PARSER_NONVERBOSE 0
 
+// Sections above this Shannon entropy (bits per byte) are flagged as likely packed or encrypted
+#define ENTROPY_HIGH_THRESHOLD 7.2
+// Sections at least this large have their histogram split across threads
+#define ENTROPY_THREAD_CHUNK (8 << 20)
+// Number of sections buffered before an inventory row group is written out
+#define INVENTORY_ROW_GROUP_SECTIONS 65536
+// Upper bound on how long continuous churn can hold back a watch batch
+#define WATCH_MAX_BATCH_DELAY_MS 2000
+
 namespace elf_parser {
 
 
@@ -72,31 +91,41 @@ namespace elf_parser {
     }
 
 
+    // Failures are reported but not fatal, so that one unreadable file does not abort a batch.
+    // The mapping is left as nullptr and Parser::validate() rejects the file
     Elf_Mmap::Elf_Mmap(std::string file_path) {
-        int fd, i;
+        int fd;
         struct stat st;
 
+        prog_mmap = nullptr;
+        mmap_size = 0;
+
         if ( (fd = open(file_path.c_str(), O_RDONLY)) < 0 ) {
             cout << "ERROR: Could not open file " << file_path << endl;
-            close(fd);
-            exit(1);
+            return;
         }
 
         if ( fstat(fd, &st) < 0 ) {
             cout << "ERROR: Could not fstat file " << file_path << endl;
             close(fd);
-            exit(1);
+            return;
         }
 
-        mmap_size = (size_t) st.st_size;
+        if ( st.st_size == 0 ) {
+            close(fd);
+            return;
+        }
 
-        prog_mmap = mmap((void*) nullptr, mmap_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        prog_mmap = mmap((void*) nullptr, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
 
         if ( (unsigned char*) prog_mmap == MAP_FAILED ) {
             cout << "ERROR: Failed to initialize memory map for " << file_path << endl;
-            close(fd);
-            exit(1);
+            prog_mmap = nullptr;
+            return;
         }
+
+        mmap_size = (size_t) st.st_size;
     }
 
 
@@ -109,6 +138,45 @@ namespace elf_parser {
     }
 
 
+    // One row of a decoded .debug_line program. file indexes Line_Table::file_names
+    struct Line_Row {
+        uint64_t address;
+        uint32_t file;
+        uint32_t line : 31;
+        uint32_t end_sequence : 1;
+    };
+
+
+    // Address -> (file, line) table decoded from .debug_line (DWARF 2-5). Rows from every
+    // sequence of every unit are merged and sorted once so lookups are a binary search
+    class Line_Table {
+        public:
+            // Function signatures
+            bool build(const unsigned char* debug_line, size_t debug_line_size,
+                       const char* line_str, size_t line_str_size,
+                       const char* str, size_t str_size, bool relocatable);
+            const Line_Row* lookup(uint64_t address);
+
+            // Class variables
+            std::vector<Line_Row> rows;
+            std::vector<std::string> file_names;
+
+
+        private:
+            // Private functions
+            bool decode_unit(const unsigned char* p, const unsigned char* end, int offset_size);
+            uint32_t intern_file(std::string path);
+
+            // Private variables
+            const char* line_str;
+            size_t line_str_size;
+            const char* str;
+            size_t str_size;
+            bool relocatable; // ET_REL: sequences legitimately start at address 0
+            std::unordered_map<std::string, uint32_t> file_ids;
+    };
+
+
     class Parser {
 
 
@@ -116,9 +184,18 @@ namespace elf_parser {
             // Function signatures
             void setup(std::string elf_prog_path);
             void cleanup();
+            bool validate();
+            const char* get_invalid_reason();
             static bool check_ELF64_magic(unsigned char p_e_ident[16], bool parser_verbose);
             bool print_elf_header();
             bool print_section_headers();
+            int find_section(std::string sh_name);
+            bool extract_section(std::string sh_name, std::string out_path);
+            bool hexdump_section(std::string sh_name);
+            bool print_section_entropy();
+            static double byte_entropy(const unsigned char* data, size_t len);
+            const Line_Row* lookup_line(uint64_t address);
+            bool print_line_info(std::vector<uint64_t> addresses);
 
             // Getters
             const char* get_e_ident();
@@ -159,15 +236,124 @@ namespace elf_parser {
                 parser_verbose = verbosity;
             }
 
+            // Accessors do no bounds checking of their own: validate() must have returned true
+            // before anything other than get_ei_class() is called
+
             // Class variables
             uint8_t parser_verbose;
             std::unique_ptr<Elf_Mmap> p_prog_mmap;
+            std::unique_ptr<Line_Table> p_line_table; // built on first lookup_line()
 
 
         private:
+            // Private functions
+            bool relocate_section(int sh_idx, std::vector<unsigned char>& contents);
+
             // Private variables
             uint8_t p_ei_class; // ELFCLASS64: 2 - ELFCLASS32: 1
             std::string p_file_path; 
+            const char* p_invalid_reason;
+    };
+
+
+    // Columnar inventory export. The stream starts with the 8 byte magic "ELFINV1\0" followed by
+    // any number of row groups. All integers are unsigned LEB128 varints; signed deltas are
+    // zigzag encoded first. A row group is laid out as:
+    //
+    //   n_files, n_sections
+    //   n_new_strings, { len, bytes }...   appended to the stream-wide string dictionary
+    //   columns, each prefixed by its length in bytes so readers can skip what they don't need:
+    //     file.path        { len, bytes } per file
+    //     file.size        varint
+    //     file.e_type      dictionary id
+    //     file.e_machine   dictionary id
+    //     file.n_sections  varint (rows of the section columns belonging to each file)
+    //     section.name     dictionary id
+    //     section.type     dictionary id
+    //     section.addr     zigzag delta from previous section address (0 at the group start)
+    //     section.offset   zigzag delta from previous section offset (0 at the group start)
+    //     section.size     varint
+    //     section.entsize  varint
+    //
+    // Dictionary ids refer to every string introduced so far in the stream, so row groups must
+    // be read in order; a reader can skip a group's columns but not its dictionary strings
+    class Inventory_Writer {
+        public:
+            // Function signatures
+            bool add_file(Parser& parser, std::string file_path);
+            bool close();
+
+            // Constructors & Destructors
+            Inventory_Writer(std::string out_path);
+            ~Inventory_Writer(void);
+
+
+        private:
+            enum Column {
+                COL_FILE_PATH, COL_FILE_SIZE, COL_FILE_TYPE, COL_FILE_MACHINE, COL_FILE_NSECT,
+                COL_SECT_NAME, COL_SECT_TYPE, COL_SECT_ADDR, COL_SECT_OFFSET, COL_SECT_SIZE, COL_SECT_ENTSIZE,
+                COL_COUNT
+            };
+
+            // Private functions
+            static void put_varint(std::string& buf, uint64_t value);
+            static void put_zigzag(std::string& buf, int64_t value);
+            uint64_t intern(const char* str);
+            bool flush_row_group();
+
+            // Private variables
+            std::ofstream out;
+            std::string columns[COL_COUNT];
+            std::unordered_map<std::string, uint64_t> dictionary;
+            std::vector<std::string> new_strings;
+            uint64_t n_files;
+            uint64_t n_sections;
+            uint64_t prev_addr;
+            uint64_t prev_offset;
+    };
+
+
+    // Cached header metadata for one file in a watched tree
+    struct Elf_Index_Entry {
+        struct timespec mtime;
+        ino_t ino;
+        off_t size;
+        uint16_t e_type;
+        uint16_t e_machine;
+        uint16_t e_shnum;
+    };
+
+
+    class Elf_Watcher {
+        public:
+            // Function signatures
+            bool watch(std::string dir_path);
+            bool index_file(std::string file_path, bool changed);
+            void remove_file(std::string file_path);
+
+            // Constructors & Destructors
+            Elf_Watcher(int debounce_ms);
+            Elf_Watcher(const Elf_Watcher&) = delete;
+            Elf_Watcher& operator=(const Elf_Watcher&) = delete;
+            ~Elf_Watcher(void);
+
+            // Class variables
+            std::unordered_map<std::string, Elf_Index_Entry> index;
+
+
+        private:
+            // Private functions
+            bool add_watch_tree(std::string dir_path);
+            void remove_watch_tree(std::string dir_path);
+            void rescan();
+            void read_events(std::map<std::string, bool>& pending);
+
+            // Private variables
+            int inotify_fd;
+            int debounce_ms;
+            bool overflowed;
+            std::string root_path;
+            std::unordered_map<int, std::string> watch_dirs; // wd -> directory path
     };
 }
 